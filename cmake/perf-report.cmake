@@ -0,0 +1,169 @@
+# Builds the day1 part2 solvers under every optimized configuration, runs their benchmarks
+# and writes a markdown table with the speedup of each configuration over the plain Release build.
+#
+# Normally invoked through the perf-report target, but it can be run directly as well:
+#   cmake -DSOURCE_DIR=. -DWORK_DIR=build/perf-report [-DTOOLCHAIN_FILE=build/conan_toolchain.cmake] \
+#         [-DBENCH_SIZE=10000000] [-DTRAIN_SIZE=1000000] [-DRUNS=5] [-DOUTPUT=report.md] \
+#         -P cmake/perf-report.cmake
+cmake_minimum_required(VERSION 3.21)
+
+if (NOT SOURCE_DIR OR NOT WORK_DIR)
+    message(FATAL_ERROR "SOURCE_DIR and WORK_DIR are required")
+endif()
+if (NOT BENCH_SIZE)
+    set(BENCH_SIZE 10000000)
+endif()
+if (NOT TRAIN_SIZE)
+    set(TRAIN_SIZE 1000000)
+endif()
+if (NOT RUNS)
+    set(RUNS 5)
+endif()
+if (NOT OUTPUT)
+    set(OUTPUT ${WORK_DIR}/perf-report.md)
+endif()
+
+set(targets day1-part2 day1-part2-presented)
+
+# the first configuration is the reference for the speedups.
+# pgo-* configurations use the flags of the configuration named after the prefix,
+# plus a training run of the instrumented build.
+set(configs baseline native lto lto-native pgo-lto pgo-lto-native)
+set(flags_baseline "")
+set(flags_native -DAOC_MARCH=native)
+set(flags_lto -DAOC_ENABLE_LTO=ON)
+set(flags_lto-native ${flags_lto} ${flags_native})
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "command failed (${result}): ${ARGN}")
+    endif()
+endfunction()
+
+function(build dir)
+    set(args -S ${SOURCE_DIR} -B ${dir} -DCMAKE_BUILD_TYPE=Release ${ARGN})
+    if (TOOLCHAIN_FILE)
+        list(APPEND args -DCMAKE_TOOLCHAIN_FILE=${TOOLCHAIN_FILE})
+    endif()
+    if (GENERATOR)
+        list(APPEND args -G ${GENERATOR})
+    endif()
+    run(${CMAKE_COMMAND} ${args})
+    run(${CMAKE_COMMAND} --build ${dir} --config Release --target ${targets} --parallel)
+endfunction()
+
+function(executable dir target out)
+    if (EXISTS ${dir}/Release/${target})
+        set(${out} ${dir}/Release/${target} PARENT_SCOPE)
+    else()
+        set(${out} ${dir}/${target} PARENT_SCOPE)
+    endif()
+endfunction()
+
+function(run_benchmarks dir target size json)
+    executable(${dir} ${target} exe)
+    run(${CMAKE_COMMAND} -E env AOC_BENCH_SIZE=${size}
+        ${exe} --gtest_also_run_disabled_tests --gtest_filter=SlidingBench.* --gtest_output=json:${json})
+endfunction()
+
+# keeps the fastest "ns" property (recorded by sliding_bench::Fixture::measure) of every SlidingBench test
+# of target in the json report in time_<config>_<target>.<test>
+macro(collect config json)
+    file(READ ${json} content)
+    string(JSON suites LENGTH ${content} testsuites)
+    math(EXPR last_suite "${suites} - 1")
+    foreach (s RANGE ${last_suite})
+        string(JSON suite GET ${content} testsuites ${s} name)
+        if (NOT suite STREQUAL "SlidingBench")
+            continue()
+        endif()
+        string(JSON tests LENGTH ${content} testsuites ${s} testsuite)
+        math(EXPR last_test "${tests} - 1")
+        foreach (t RANGE ${last_test})
+            string(JSON name GET ${content} testsuites ${s} testsuite ${t} name)
+            string(JSON ns GET ${content} testsuites ${s} testsuite ${t} ns)
+            string(REGEX REPLACE "^DISABLED_" "" name ${name})
+            set(row ${target}.${name})
+            if (NOT row IN_LIST rows)
+                list(APPEND rows ${row})
+            endif()
+            if (NOT DEFINED time_${config}_${row} OR ns LESS time_${config}_${row})
+                set(time_${config}_${row} ${ns})
+            endif()
+        endforeach()
+    endforeach()
+endmacro()
+
+set(rows "")
+foreach (config IN LISTS configs)
+    set(dir ${WORK_DIR}/${config})
+    if (config MATCHES "^pgo-(.+)$")
+        set(flags ${flags_${CMAKE_MATCH_1}} -DAOC_PGO_DIR=${dir}/pgo)
+        file(REMOVE_RECURSE ${dir}/pgo)
+        build(${dir} ${flags} -DAOC_PGO=GENERATE)
+        foreach (target IN LISTS targets)
+            run_benchmarks(${dir} ${target} ${TRAIN_SIZE} ${dir}/train-${target}.json)
+        endforeach()
+        # without profiles the "pgo" build would just be the lto one, never report that as pgo
+        file(GLOB_RECURSE gcda ${dir}/pgo/*.gcda)
+        file(GLOB profraw ${dir}/pgo/*.profraw)
+        if (NOT gcda AND NOT profraw)
+            message(FATAL_ERROR "the training runs of ${config} left no *.gcda or *.profraw files in ${dir}/pgo")
+        endif()
+        if (profraw)
+            find_program(LLVM_PROFDATA NAMES llvm-profdata REQUIRED)
+            run(${LLVM_PROFDATA} merge -o ${dir}/pgo/default.profdata ${profraw})
+        endif()
+        build(${dir} ${flags} -DAOC_PGO=USE)
+    else()
+        build(${dir} ${flags_${config}} -DAOC_PGO=)
+    endif()
+
+    foreach (target IN LISTS targets)
+        foreach (i RANGE 1 ${RUNS})
+            set(json ${dir}/bench-${target}-${i}.json)
+            run_benchmarks(${dir} ${target} ${BENCH_SIZE} ${json})
+            collect(${config} ${json})
+        endforeach()
+    endforeach()
+endforeach()
+
+# times are the fastest call over all runs, speedups are relative to the first configuration
+list(GET configs 0 reference)
+set(header "| solver |")
+set(separator "|---|")
+foreach (config IN LISTS configs)
+    string(APPEND header " ${config} |")
+    string(APPEND separator "---|")
+endforeach()
+set(table "${header}\n${separator}\n")
+foreach (row IN LISTS rows)
+    set(line "| ${row} |")
+    foreach (config IN LISTS configs)
+        set(total ${time_${config}_${row}})
+        math(EXPR us "${total} / 1000")
+        math(EXPR ms "${us} / 1000")
+        math(EXPR ms_fraction "${us} % 1000 + 1000")
+        string(SUBSTRING ${ms_fraction} 1 3 ms_fraction)
+        string(APPEND line " ${ms}.${ms_fraction} ms")
+        if (NOT config STREQUAL reference)
+            if (total GREATER 0)
+                math(EXPR speedup "${time_${reference}_${row}} * 100 / ${total}")
+                math(EXPR speedup_int "${speedup} / 100")
+                math(EXPR speedup_fraction "${speedup} % 100")
+                if (speedup_fraction LESS 10)
+                    set(speedup_fraction "0${speedup_fraction}")
+                endif()
+                string(APPEND line " (${speedup_int}.${speedup_fraction}x)")
+            else()
+                string(APPEND line " (n/a)")
+            endif()
+        endif()
+        string(APPEND line " |")
+    endforeach()
+    string(APPEND table "${line}\n")
+endforeach()
+
+file(WRITE ${OUTPUT} "${table}")
+message(STATUS "perf report (${BENCH_SIZE} elements, fastest call of ${RUNS} runs) written to ${OUTPUT}\n${table}")
@@ -7,6 +7,8 @@
 
 #include "gtest/gtest.h"
 
+#include "sliding-bench.h"
+
 /**
  * we are given an additional task. Instead of comparing every measurement,
  * we first need to compute a sliding window sum over three elements.
@@ -101,9 +103,10 @@ namespace {
 
         return total;
     }
-
 }
 
+using SlidingBench = sliding_bench::Fixture<count_lazy>;
+
 
 TEST(sliding, loop) {
     const auto input = std::vector{0U, 1U, 2U, 3U}; // 1
@@ -119,3 +122,15 @@ TEST(sliding, count_lazy_sol) {
     const auto input = std::vector{0U, 1U, 2U, 3U}; // 1
     EXPECT_EQ(count_lazy(input), 1) << " on input 0 1 2 3\n";
 }
+
+TEST_F(SlidingBench, DISABLED_sliding_count) {
+    EXPECT_EQ(measure(sliding_count), expected);
+}
+
+TEST_F(SlidingBench, DISABLED_ranges_sol) {
+    EXPECT_EQ(measure(ranges_sol), expected);
+}
+
+TEST_F(SlidingBench, DISABLED_count_lazy_sol) {
+    EXPECT_EQ(measure(count_lazy), expected);
+}
@@ -2,13 +2,20 @@
 // Created by kobic on 12/7/21.
 //
 
+#include <algorithm>
+#include <charconv>
+#include <istream>
 #include <vector>
 #include <numeric>
+#include <stdexcept>
+#include <string>
 
 #include "range/v3/all.hpp"
 #include "fmt/format.h"
 #include "gtest/gtest.h"
 
+#include "sliding-bench.h"
+
 /**
  * we are given an additional task. Instead of comparing every measurement,
  * we first need to compute a sliding window sum over three elements.
@@ -103,8 +110,80 @@ namespace {
         }
         return total;
     }
+
+    // default memory budget (in bytes) for the out-of-core variant
+    constexpr std::size_t default_memory_budget = 1U << 20U;
+    // the smallest budget: a tile of a single element, its partial sum and the 4 carried partial sums
+    constexpr std::size_t min_memory_budget = (1 + 1 + 4) * sizeof(uint32_t);
+
+    /**
+     * out-of-core version of the partial sum variants.
+     * the input is consumed from a stream in fixed-size tiles, so we never hold the whole input
+     * nor the whole partial sum in memory. both buffers together stay within memory_budget bytes,
+     * which must be at least min_memory_budget (std::invalid_argument otherwise).
+     * the only state kept across tiles is the running total and the last 4 partial sums,
+     * which is exactly what is needed to compute the previous window and the current one.
+     * the count is 64 bit, inputs bigger than RAM can have more than 2^32 increasing windows.
+     * throws std::runtime_error on anything that is not a measurement, instead of stopping there.
+     */
+    uint64_t count_increasing_windows_partial_sum(std::istream& input,
+                                                  const std::size_t memory_budget = default_memory_budget) {
+        // prefix[0..carry) holds the partial sums of the 4 elements preceding the current tile.
+        // before the first tile they are 0, which is the same as the back_diff == 0 case above.
+        constexpr std::size_t carry = 4;
+        if (memory_budget < min_memory_budget) {
+            throw std::invalid_argument("memory budget of " + std::to_string(memory_budget) +
+                                        " bytes is below the minimum of " + std::to_string(min_memory_budget));
+        }
+        // tile values + tile partial sums + carried partial sums
+        const std::size_t tile = (memory_budget / sizeof(uint32_t) - carry) / 2;
+        std::vector<uint32_t> values;
+        values.reserve(tile);
+        std::vector<uint32_t> prefix(carry + tile);
+        uint64_t total{};
+        for (uint64_t index{};;) {
+            values.clear();
+            // tokens are parsed with from_chars, operator>> takes "-4" as 4294967292 and an out of range
+            // last value looks just like the end of the input
+            for (std::string token; values.size() < tile && input >> token;) {
+                uint32_t value{};
+                const auto end = token.data() + token.size();
+                if (const auto [ptr, ec] = std::from_chars(token.data(), end, value); ec != std::errc{} || ptr != end) {
+                    throw std::runtime_error("invalid measurement '" + token + "' after element " +
+                                             std::to_string(index + values.size()));
+                }
+                values.push_back(value);
+            }
+            if (input.bad()) {
+                throw std::runtime_error("failed to read measurements after element " +
+                                         std::to_string(index + values.size()));
+            }
+            if (values.empty()) {
+                break;
+            }
+            std::inclusive_scan(std::begin(values), std::end(values), std::begin(prefix) + carry,
+                                std::plus<>{}, prefix[carry - 1]);
+            for (std::size_t k{carry}; k < carry + values.size(); ++k, ++index) {
+                // the first window ends at index 2, the first comparison happens at index 3
+                if (index < 3) {
+                    continue;
+                }
+                const uint32_t x = prefix[k - 1] - prefix[k - 4];
+                const uint32_t y = prefix[k] - prefix[k - 3];
+                if (x < y) {
+                    ++total;
+                }
+            }
+            // the last 4 partial sums of this tile become the carry of the next one
+            std::copy(std::begin(prefix) + values.size(), std::begin(prefix) + values.size() + carry,
+                      std::begin(prefix));
+        }
+        return total;
+    }
 }
 
+using SlidingBench = sliding_bench::Fixture<count_increasing_windows_lazy>;
+
 TEST(SlidingTest, Lazy) {
     std::vector<std::pair<std::string, uint32_t>> inputs = {
             {"",                                        0},     // not enough elements for a window
@@ -192,3 +271,79 @@ TEST(SlidingTest, ranges_sliding) {
         EXPECT_EQ(count_increasing_sliding_window(v), i.second) << " on input " << i.first;
     }
 }
+
+TEST(SlidingTest, partial_sum_out_of_core) {
+    std::vector<std::pair<std::string, uint32_t>> inputs = {
+            {"",                                        0},     // not enough elements for a window
+            {"0 1",                                     0},     // not enough elements for a window
+            {"0 1 0",                                   0},     // a single window
+            {"0 0 0 0 0 0",                             0},     // monotonic, no increase
+            {"0 1 2 3",                                 1},     // two windows, increasing
+            {"3 2 1 0",                                 0},     // two windows, decreasing
+            {"0 1 0 1 0 1",                             2},     // 1, 2, 1, 2 - two increasing
+            {"199 200 208 210 200 207 240 269 260 263", 5}, // from aoc
+    };
+
+    // from a single element per tile up to everything in one tile
+    for (const std::size_t budget : {min_memory_budget, 28UL, 32UL, 40UL, 64UL, default_memory_budget}) {
+        for (auto &i: inputs) {
+            std::stringstream s(i.first);
+            EXPECT_EQ(count_increasing_windows_partial_sum(s, budget), i.second)
+                << " on input " << i.first << " with budget " << budget;
+        }
+    }
+}
+
+TEST(SlidingTest, partial_sum_out_of_core_bad_input) {
+    // a bad token must not look like the end of the input, wherever it falls in the tiles
+    for (const std::size_t budget : {min_memory_budget, 36UL, default_memory_budget}) {
+        for (const auto input : {"0 1 2 3 x 4 5 6 7 8", "x", "0 1 2 3 4 5 6 7 8 9 10 x 11",
+                                  "0 1 2 3 99999999999", "0 1 2 -3", "1 2 3 4x 5"}) {
+            std::stringstream s(input);
+            EXPECT_THROW(count_increasing_windows_partial_sum(s, budget), std::runtime_error)
+                << " on input " << input << " with budget " << budget;
+        }
+    }
+}
+
+TEST(SlidingTest, partial_sum_out_of_core_min_budget) {
+    for (const std::size_t budget : {0UL, 4UL, min_memory_budget - 1}) {
+        std::stringstream s("0 1 2 3");
+        EXPECT_THROW(count_increasing_windows_partial_sum(s, budget), std::invalid_argument)
+            << " with budget " << budget;
+    }
+}
+
+TEST(SlidingTest, partial_sum_out_of_core_vs_in_memory) {
+    // the results must not depend on where the tile boundaries fall
+    for (const uint32_t size : {4U, 5U, 7U, 8U, 9U, 100U, 1000U, 4099U}) {
+        const auto v = sliding_bench::generate_input(size, size);
+        std::stringstream text;
+        std::copy(std::begin(v), std::end(v), std::ostream_iterator<uint32_t>(text, " "));
+        const auto expected = count_increasing_windows_partial_sum(v);
+        for (const std::size_t budget : {min_memory_budget, 36UL, 100UL, 1024UL, default_memory_budget}) {
+            std::stringstream s(text.str());
+            EXPECT_EQ(count_increasing_windows_partial_sum(s, budget), expected)
+                << " on " << size << " elements with budget " << budget;
+        }
+    }
+}
+
+TEST_F(SlidingBench, DISABLED_lazy) {
+    EXPECT_EQ(measure(count_increasing_windows_lazy), expected);
+}
+
+TEST_F(SlidingBench, DISABLED_partial_loop) {
+    EXPECT_EQ(measure(count_increasing_windows_partial_loop), expected);
+}
+
+TEST_F(SlidingBench, DISABLED_partial_sum) {
+    EXPECT_EQ(measure([](const auto& v) {
+        // the stream overload would be ambiguous here
+        return count_increasing_windows_partial_sum(v);
+    }), expected);
+}
+
+TEST_F(SlidingBench, DISABLED_ranges_sliding) {
+    EXPECT_EQ(measure(count_increasing_sliding_window), expected);
+}
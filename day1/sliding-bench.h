@@ -0,0 +1,89 @@
+//
+// generated input and the benchmark fixture shared by the day1 part2 solvers.
+//
+
+#ifndef ADVENT_OF_CODE_SLIDING_BENCH_H
+#define ADVENT_OF_CODE_SLIDING_BENCH_H
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace sliding_bench {
+
+    // pseudo random measurements in [0, 1000), always the same sequence for the same seed
+    inline std::vector<uint32_t> generate_input(const std::size_t size, uint32_t seed) {
+        std::vector<uint32_t> v(size);
+        std::generate(std::begin(v), std::end(v), [&seed]() {
+            seed = seed * 1103515245U + 12345U;
+            return (seed >> 16U) % 1000U;
+        });
+        return v;
+    }
+
+    // a positive number from the environment, or fallback when the variable is not set
+    inline std::size_t env_count(const char* name, const std::size_t fallback) {
+        const char* env = std::getenv(name);
+        if (env == nullptr) {
+            return fallback;
+        }
+        std::size_t value{};
+        const auto end = env + std::strlen(env);
+        if (const auto [ptr, ec] = std::from_chars(env, end, value); ec != std::errc{} || ptr != end || value == 0) {
+            throw std::invalid_argument(std::string(name) + " must be a positive integer, got '" + env + "'");
+        }
+        return value;
+    }
+
+    /**
+     * input for the benchmarks (disabled by default, run with --gtest_also_run_disabled_tests).
+     * the number of elements can be overridden with the AOC_BENCH_SIZE environment variable.
+     */
+    inline std::vector<uint32_t> bench_input() {
+        return generate_input(env_count("AOC_BENCH_SIZE", 10'000'000), 42U);
+    }
+
+    /**
+     * the input is generated once per suite and checked against the Reference solver.
+     * measure() times the solver alone with steady_clock over AOC_BENCH_ITERATIONS calls
+     * and records the fastest call as the "ns" property of the test (in the gtest json/xml report),
+     * gtest's own per test time only has millisecond resolution.
+     */
+    template<auto Reference>
+    class Fixture : public ::testing::Test {
+    protected:
+        static void SetUpTestSuite() {
+            input = bench_input();
+            expected = Reference(input);
+        }
+
+        template<typename Solver>
+        static uint32_t measure(Solver solver) {
+            const auto iterations = env_count("AOC_BENCH_ITERATIONS", 10);
+            auto best = std::chrono::steady_clock::duration::max();
+            uint32_t result{};
+            for (std::size_t i{}; i < iterations; ++i) {
+                const auto start = std::chrono::steady_clock::now();
+                result = solver(input);
+                const auto elapsed = std::chrono::steady_clock::now() - start;
+                best = std::min(best, elapsed);
+                // the solvers are pure, keep the compiler from hoisting the calls out of the loop
+                asm volatile("" : : "r"(result) : "memory");
+            }
+            RecordProperty("ns", std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(best).count()));
+            return result;
+        }
+
+        static inline std::vector<uint32_t> input;
+        static inline uint32_t expected{};
+    };
+}
+
+#endif //ADVENT_OF_CODE_SLIDING_BENCH_H
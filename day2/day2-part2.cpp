@@ -7,16 +7,31 @@
  * Instead of up and down representing a direct movement, they change the direction,
  * with forward then applying this direction.
  */
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
 #include <regex>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "gtest/gtest.h"
 
 namespace {
 
+    // 64 bit, depth grows with direction * value and overflows 32 bit on long command logs
     struct Position {
-        int32_t horizontal{};
-        int32_t depth{};
-        int32_t direction{};
+        int64_t horizontal{};
+        int64_t depth{};
+        int64_t direction{};
 
         // big hammer but works for == (we dont need the rest like "<" etc)
         friend auto operator<=>(const Position &, const Position &) = default;
@@ -58,6 +73,231 @@ namespace {
         }
         return position;
     }
+
+    /**
+     * where a replay of a command log stopped: the byte offset of the next line to execute
+     * and the position after executing everything before it.
+     * the start and a hash of the last executed line identify the log, so a checkpoint
+     * of another (or a truncated) log is rejected on resume.
+     */
+    struct Checkpoint {
+        uint64_t offset{};
+        Position position;
+        uint64_t line_offset{};
+        uint64_t line_hash{};
+    };
+
+    // FNV-1a, unlike std::hash it is the same for every build
+    uint64_t line_hash(const std::string_view line) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (const unsigned char c : line) {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // just enough of a posix file descriptor to write and fsync, closed on scope exit
+    class File {
+    public:
+        File(const std::filesystem::path& path, const int flags) : fd_(::open(path.c_str(), flags, 0644)) {
+            if (fd_ < 0) {
+                throw std::system_error(errno, std::generic_category(), "open " + path.string());
+            }
+        }
+
+        File(const File &) = delete;
+        File& operator=(const File &) = delete;
+
+        ~File() {
+            ::close(fd_);
+        }
+
+        void write(std::string_view data) {
+            while (!data.empty()) {
+                const auto written = ::write(fd_, data.data(), data.size());
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::generic_category(), "write checkpoint");
+                }
+                data.remove_prefix(static_cast<std::size_t>(written));
+            }
+        }
+
+        void sync() {
+            if (::fsync(fd_) != 0) {
+                throw std::system_error(errno, std::generic_category(), "fsync checkpoint");
+            }
+        }
+
+    private:
+        const int fd_;
+    };
+
+    /**
+     * durable and atomic: the checkpoint goes to a temporary file which is fsync-ed, renamed over the
+     * old one, and then the directory is fsync-ed so the rename itself survives a power loss.
+     * either the old or the new checkpoint is found afterwards, never half of one.
+     */
+    void save_checkpoint(const std::filesystem::path& path, const Checkpoint& checkpoint) {
+        auto tmp = path;
+        tmp += ".tmp";
+        {
+            File file(tmp, O_WRONLY | O_CREAT | O_TRUNC);
+            std::ostringstream os;
+            os << checkpoint.offset << ' ' << checkpoint.position.horizontal << ' '
+               << checkpoint.position.depth << ' ' << checkpoint.position.direction << ' '
+               << checkpoint.line_offset << ' ' << checkpoint.line_hash << '\n';
+            file.write(os.str());
+            file.sync();
+        }
+        std::filesystem::rename(tmp, path);
+        const auto dir = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+        File(dir, O_RDONLY | O_DIRECTORY).sync();
+    }
+
+    std::optional<Checkpoint> load_checkpoint(const std::filesystem::path& path) {
+        std::ifstream is(path);
+        Checkpoint checkpoint;
+        if (is >> checkpoint.offset >> checkpoint.position.horizontal >> checkpoint.position.depth
+               >> checkpoint.position.direction >> checkpoint.line_offset >> checkpoint.line_hash) {
+            return checkpoint;
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * writes checkpoints on a background thread so the replay loop never waits for the disk.
+     * only the latest checkpoint matters, a pending one that was not written yet is simply replaced.
+     * a failed write is rethrown by the next post(), so a replay does not go on without checkpoints.
+     */
+    class CheckpointWriter {
+    public:
+        explicit CheckpointWriter(std::filesystem::path path) : path_(std::move(path)), thread_([this] { run(); }) {}
+
+        CheckpointWriter(const CheckpointWriter &) = delete;
+        CheckpointWriter& operator=(const CheckpointWriter &) = delete;
+
+        ~CheckpointWriter() {
+            stop();
+        }
+
+        void post(const Checkpoint& checkpoint) {
+            {
+                std::lock_guard lock(mutex_);
+                if (error_) {
+                    std::rethrow_exception(error_);
+                }
+                pending_ = checkpoint;
+            }
+            cv_.notify_one();
+        }
+
+        // writes what is still pending and rethrows if any write failed
+        void finish() {
+            stop();
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+        }
+
+    private:
+        void stop() {
+            {
+                std::lock_guard lock(mutex_);
+                done_ = true;
+            }
+            cv_.notify_one();
+            if (thread_.joinable()) {
+                thread_.join();
+            }
+        }
+
+        void run() {
+            std::unique_lock lock(mutex_);
+            while (true) {
+                cv_.wait(lock, [this] { return pending_ || done_; });
+                if (!pending_) {
+                    return;
+                }
+                const auto checkpoint = *std::exchange(pending_, std::nullopt);
+                lock.unlock();
+                std::exception_ptr error;
+                try {
+                    save_checkpoint(path_, checkpoint);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                lock.lock();
+                if (error) {
+                    error_ = error;
+                }
+            }
+        }
+
+        const std::filesystem::path path_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::optional<Checkpoint> pending_;
+        bool done_{};
+        std::exception_ptr error_;
+        // last, everything above must be ready when the thread starts
+        std::thread thread_;
+    };
+
+    /**
+     * replays a (possibly huge) command log, posting a checkpoint every checkpoint_interval lines
+     * and once more at the end. with resume, the replay seeks straight to the checkpoint in
+     * checkpoint_path (if there is one) and continues from the position stored there.
+     * throws std::runtime_error if the log cannot seek there, does not match the checkpoint or fails to read,
+     * and std::system_error as soon as a checkpoint cannot be written.
+     */
+    Position navigate(std::istream& log, const std::filesystem::path& checkpoint_path,
+                      const uint64_t checkpoint_interval, const bool resume) {
+        Checkpoint checkpoint;
+        // always holds the last executed line, for the hash of the checkpoints
+        std::string line;
+        if (resume) {
+            if (const auto saved = load_checkpoint(checkpoint_path); saved && saved->offset != 0) {
+                checkpoint = *saved;
+                // reading the last executed line again verifies the log and leaves it at the checkpoint offset
+                log.seekg(static_cast<std::streamoff>(checkpoint.line_offset));
+                if (!log || !std::getline(log, line)) {
+                    throw std::runtime_error("cannot seek the log to checkpoint offset " +
+                                             std::to_string(checkpoint.offset));
+                }
+                if (line_hash(line) != checkpoint.line_hash ||
+                    checkpoint.line_offset + line.size() + (log.eof() ? 0 : 1) != checkpoint.offset) {
+                    throw std::runtime_error("checkpoint " + checkpoint_path.string() + " is not from this log");
+                }
+            }
+        }
+        // synchronously once, so a checkpoint_path that cannot be written fails before the replay starts
+        checkpoint.line_hash = line_hash(line);
+        save_checkpoint(checkpoint_path, checkpoint);
+        CheckpointWriter writer(checkpoint_path);
+        std::string next;
+        for (uint64_t lines{1}; std::getline(log, next); ++lines) {
+            line.swap(next);
+            navigate(checkpoint.position, line);
+            checkpoint.line_offset = checkpoint.offset;
+            // the last line may come without a newline
+            checkpoint.offset += line.size() + (log.eof() ? 0 : 1);
+            if (checkpoint_interval != 0 && lines % checkpoint_interval == 0) {
+                checkpoint.line_hash = line_hash(line);
+                writer.post(checkpoint);
+            }
+        }
+        // everything executed so far is consistent, but a read error must not pass for the end of the log
+        checkpoint.line_hash = line_hash(line);
+        writer.post(checkpoint);
+        writer.finish();
+        if (log.bad()) {
+            throw std::runtime_error("failed to read the log at offset " + std::to_string(checkpoint.offset));
+        }
+        return checkpoint.position;
+    }
 }
 
 TEST(NavigationTest, Single) {
@@ -92,3 +332,217 @@ forward 2)", {.horizontal = 2, .depth = 80, .direction = 40}},
         EXPECT_EQ(navigate(pos, str), position) << "with input " << str;
     }
 }
+
+namespace {
+
+    // per test and per process, so concurrent test runs do not share checkpoints
+    std::filesystem::path checkpoint_path() {
+        const auto* test = ::testing::UnitTest::GetInstance()->current_test_info();
+        return std::filesystem::temp_directory_path() /
+               ("day2-part2-" + std::string(test->name()) + "-" + std::to_string(::getpid()));
+    }
+
+    // a log whose replay "crashes" (throws) once the first limit bytes were read
+    class CrashingLog : public std::stringbuf {
+    public:
+        CrashingLog(const std::string& log, const std::size_t limit) : std::stringbuf(log.substr(0, limit)) {}
+
+    protected:
+        int_type underflow() override {
+            const auto c = std::stringbuf::underflow();
+            if (traits_type::eq_int_type(c, traits_type::eof())) {
+                throw std::runtime_error("crash");
+            }
+            return c;
+        }
+    };
+}
+
+TEST(NavigationTest, Checkpointed) {
+    const std::string input = R"(forward 5
+down 5
+forward 8
+up 3
+down 8
+forward 2
+)";
+    const Position expected{.horizontal = 15, .depth = 60, .direction = 10};
+    const auto path = checkpoint_path();
+    for (const uint64_t interval : {0U, 1U, 2U, 4U, 100U}) {
+        std::filesystem::remove(path);
+        std::istringstream is(input);
+        EXPECT_EQ(navigate(is, path, interval, false), expected) << "with interval " << interval;
+        // the final checkpoint points past the last line
+        const auto checkpoint = load_checkpoint(path);
+        ASSERT_TRUE(checkpoint) << "with interval " << interval;
+        EXPECT_EQ(checkpoint->offset, input.size()) << "with interval " << interval;
+        EXPECT_EQ(checkpoint->position, expected) << "with interval " << interval;
+        EXPECT_EQ(checkpoint->line_offset, input.rfind("forward 2")) << "with interval " << interval;
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(NavigationTest, Resume) {
+    const std::string input = R"(forward 5
+down 5
+forward 8
+up 3
+down 8
+forward 2)";
+    const Position expected{.horizontal = 15, .depth = 60, .direction = 10};
+    const auto path = checkpoint_path();
+
+    // no checkpoint yet, starts from the beginning
+    std::filesystem::remove(path);
+    {
+        std::istringstream is(input);
+        EXPECT_EQ(navigate(is, path, 2, true), expected);
+    }
+
+    // a replay that died after the first 3 lines, resuming must not execute them again
+    std::filesystem::remove(path);
+    {
+        std::istringstream is(input.substr(0, input.find("up")));
+        EXPECT_EQ(navigate(is, path, 2, false), (Position{.horizontal = 13, .depth = 40, .direction = 5}));
+    }
+    {
+        std::istringstream is(input);
+        EXPECT_EQ(navigate(is, path, 2, true), expected);
+    }
+
+    // resuming a finished replay executes nothing
+    {
+        std::istringstream is(input);
+        EXPECT_EQ(navigate(is, path, 2, true), expected);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(NavigationTest, ResumeMidStream) {
+    const std::string input = R"(forward 5
+down 5
+forward 8
+up 3
+down 8
+forward 2
+)";
+    const auto path = checkpoint_path();
+    std::filesystem::remove(path);
+
+    // with interval 2, the crash while reading line 4 leaves the checkpoint of line 2 behind,
+    // line 3 was already executed but is not part of it
+    {
+        CrashingLog log(input, input.find("up") + 1);
+        std::istream is(&log);
+        is.exceptions(std::ios::badbit);
+        EXPECT_THROW(navigate(is, path, 2, false), std::runtime_error);
+    }
+    const auto checkpoint = load_checkpoint(path);
+    ASSERT_TRUE(checkpoint);
+    EXPECT_EQ(checkpoint->offset, input.find("forward 8"));
+    EXPECT_EQ(checkpoint->position, (Position{.horizontal = 5, .depth = 0, .direction = 5}));
+
+    // lines 3 to 6 are executed exactly once, executing "forward 8" again would add 8 and 40 more
+    {
+        std::istringstream is(input);
+        EXPECT_EQ(navigate(is, path, 2, true), (Position{.horizontal = 15, .depth = 60, .direction = 10}));
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(NavigationTest, ReadError) {
+    const std::string input = R"(forward 5
+down 5
+forward 8
+up 3
+down 8
+forward 2
+)";
+    const auto path = checkpoint_path();
+    std::filesystem::remove(path);
+
+    // without exceptions() the read error only sets badbit, it must not look like the end of the log
+    {
+        CrashingLog log(input, input.find("up") + 1);
+        std::istream is(&log);
+        EXPECT_THROW(navigate(is, path, 2, false), std::runtime_error);
+    }
+    // the last checkpoint holds the 3 lines that were executed
+    const auto checkpoint = load_checkpoint(path);
+    ASSERT_TRUE(checkpoint);
+    EXPECT_EQ(checkpoint->offset, input.find("up"));
+    EXPECT_EQ(checkpoint->position, (Position{.horizontal = 13, .depth = 40, .direction = 5}));
+    {
+        std::istringstream is(input);
+        EXPECT_EQ(navigate(is, path, 2, true), (Position{.horizontal = 15, .depth = 60, .direction = 10}));
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(NavigationTest, UnwritableCheckpoint) {
+    const auto missing = std::filesystem::temp_directory_path() / (checkpoint_path().filename().string() + "-missing");
+    std::filesystem::remove_all(missing);
+
+    // fails before executing a single line
+    {
+        std::istringstream is("forward 5\ndown 5\n");
+        EXPECT_THROW(navigate(is, missing / "checkpoint", 1, false), std::system_error);
+        EXPECT_EQ(is.tellg(), 0);
+    }
+
+    // a write failing in the background is rethrown by one of the next posts
+    {
+        using namespace std::chrono_literals;
+        CheckpointWriter writer(missing / "checkpoint");
+        const auto deadline = std::chrono::steady_clock::now() + 10s;
+        EXPECT_THROW({
+            while (std::chrono::steady_clock::now() < deadline) {
+                writer.post(Checkpoint{});
+                std::this_thread::sleep_for(1ms);
+            }
+        }, std::system_error);
+    }
+}
+
+TEST(NavigationTest, Wide) {
+    // a depth of 2 * 10^13 is far past 32 bit
+    const std::string input = "down 10000\nforward 1000000000\nforward 1000000000\n";
+    const auto path = checkpoint_path();
+    std::filesystem::remove(path);
+    std::istringstream is(input);
+    EXPECT_EQ(navigate(is, path, 1, false),
+              (Position{.horizontal = 2'000'000'000, .depth = 20'000'000'000'000, .direction = 10'000}));
+    const auto checkpoint = load_checkpoint(path);
+    ASSERT_TRUE(checkpoint);
+    EXPECT_EQ(checkpoint->position.depth, 20'000'000'000'000);
+    std::filesystem::remove(path);
+}
+
+TEST(NavigationTest, ResumeRejectsOtherLogs) {
+    const std::string input = R"(forward 5
+down 5
+forward 7
+)";
+    const auto path = checkpoint_path();
+    std::filesystem::remove(path);
+    {
+        std::istringstream is(input);
+        navigate(is, path, 1, false);
+    }
+    // the checkpoint is past the end of a shorter log
+    {
+        std::istringstream is("forward 5\n");
+        EXPECT_THROW(navigate(is, path, 1, true), std::runtime_error);
+    }
+    // same length, different last line
+    {
+        std::istringstream is("forward 5\ndown 5\nforward 8\n");
+        EXPECT_THROW(navigate(is, path, 1, true), std::runtime_error);
+    }
+    // the checkpoint is left alone by a rejected resume
+    {
+        std::istringstream is(input);
+        EXPECT_EQ(navigate(is, path, 1, true), (Position{.horizontal = 12, .depth = 35, .direction = 5}));
+    }
+    std::filesystem::remove(path);
+}